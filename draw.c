@@ -1,43 +1,61 @@
 // draw.c
+#include "draw.h"
+#include <math.h>
+
 #include "raylib.h"
 
 #include "world.h"
+#include "util.h"
+
+static inline int empty_cells(CellRect r) {
+    return r.w <= 0 || r.h <= 0;
+}
+
+// part of the world the camera can see (rotation is not supported)
+CellRect visible_cells(World *world, Camera2D camera, int cell_size, int screen_width, int screen_height) {
+    float left = (0 - camera.offset.x) / camera.zoom + camera.target.x;
+    float top = (0 - camera.offset.y) / camera.zoom + camera.target.y;
+    float right = (screen_width - camera.offset.x) / camera.zoom + camera.target.x;
+    float bottom = (screen_height - camera.offset.y) / camera.zoom + camera.target.y;
+    int x0 = (int)floorf(left / cell_size);
+    int y0 = (int)floorf(top / cell_size);
+    int x1 = (int)ceilf(right / cell_size);
+    int y1 = (int)ceilf(bottom / cell_size);
+    CellRect world_rect = { 0, 0, world->width, world->height };
+    return clip_cells((CellRect){ x0, y0, x1 - x0, y1 - y0 }, world_rect);
+}
+
+CellRect live_cells(World *world) {
+    int x0, y0, x1, y1;
+    live_bounds(world, &x0, &y0, &x1, &y1);
+    CellRect world_rect = { 0, 0, world->width, world->height };
+    return clip_cells((CellRect){ x0, y0, x1 - x0, y1 - y0 }, world_rect);
+}
+
+CellRect union_cells(CellRect a, CellRect b) {
+    if (empty_cells(a)) return b;
+    if (empty_cells(b)) return a;
+    int x0 = min(a.x, b.x), y0 = min(a.y, b.y);
+    int x1 = max(a.x + a.w, b.x + b.w), y1 = max(a.y + a.h, b.y + b.h);
+    return (CellRect){ x0, y0, x1 - x0, y1 - y0 };
+}
 
-void draw_world(World *world, Color *pixelBuffer, const Color *colors, unsigned char full_redraw) {
+CellRect clip_cells(CellRect a, CellRect b) {
+    int x0 = max(a.x, b.x), y0 = max(a.y, b.y);
+    int x1 = min(a.x + a.w, b.x + b.w), y1 = min(a.y + a.h, b.y + b.h);
+    if (x0 >= x1 || y0 >= y1) return (CellRect){ 0, 0, 0, 0 };
+    return (CellRect){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+// colours the region into pixelBuffer packed with row length region.w, ready for UpdateTextureRec
+void draw_world(World *world, Color *pixelBuffer, const Color *colors, CellRect region) {
     unsigned char* current = world->current_world;
     unsigned int stride = world->stride;
-    // for (int i = 0; i < world->height; i++) {
-    //     for (int j = 0; j < world->width; j++) {
-    //         unsigned char cell = current[(i + 1) * stride + (j + 1)];
-    //         pixelBuffer[i * world->width + j] = COLORS[cell];
-
-    //     }
-    // }
-    int min_y, max_y, min_x, max_x;
-    if (full_redraw) {
-        min_y = 0;
-        max_y = world->width;
-        min_x = 0;
-        max_x = world->height;
-    } else {
-        min_y = world->min_living_y - 1;
-        max_y = world->max_living_y + 1;
-        min_x = world->min_living_x - 1;
-        max_x = world->max_living_x + 1;
-        if (min_x < 0 || max_x > world->width) {
-            max_x = world->width;
-            min_x = 0;
-        }
-        if (min_y < 0 || max_y > world->height) {
-            max_y = world->height;
-            min_y = 0;
-        }     
-    }
-    for (int i = min_y; i < max_y; i++) {
-        for (int j = min_x; j < max_x; j++) {
-            unsigned char cell = current[(i + 1) * stride + (j + 1)];
-            pixelBuffer[i * world->width + j] = colors[cell];
-
+    for (int i = 0; i < region.h; i++) {
+        const unsigned char *row = current + (region.y + i + world->border) * stride + region.x + world->border;
+        Color *pixels = pixelBuffer + i * region.w;
+        for (int j = 0; j < region.w; j++) {
+            pixels[j] = colors[row[j]];
         }
     }
-}
\ No newline at end of file
+}
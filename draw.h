@@ -6,6 +6,14 @@
 
 #include "world.h"
 
-void draw_world(World *world, Color *pixelBuffer, const Color *colors, unsigned char full_redraw);
+typedef struct {
+    int x, y, w, h;     // в клетках мира
+} CellRect;
 
-#endif
\ No newline at end of file
+CellRect visible_cells(World *world, Camera2D camera, int cell_size, int screen_width, int screen_height);
+CellRect live_cells(World *world);
+CellRect union_cells(CellRect a, CellRect b);
+CellRect clip_cells(CellRect a, CellRect b);
+void draw_world(World *world, Color *pixelBuffer, const Color *colors, CellRect region);
+
+#endif
@@ -0,0 +1,164 @@
+// edit.c
+#include "edit.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "world.h"
+#include "util.h"
+
+// clips a rectangle to the world, returns 0 if nothing is left
+static int clip_rect(World *world, int *x, int *y, int *w, int *h) {
+    int x0 = max(*x, 0);
+    int y0 = max(*y, 0);
+    int x1 = min(*x + *w, (int)world->width);
+    int y1 = min(*y + *h, (int)world->height);
+    if (x0 >= x1 || y0 >= y1) return 0;
+    *x = x0;
+    *y = y0;
+    *w = x1 - x0;
+    *h = y1 - y0;
+    return 1;
+}
+
+// grows the living bounding box once per batch (box is in ghost-offset coordinates)
+static void touch_rect(World *world, int x, int y, int w, int h, unsigned char value) {
+    if (!value || !clip_rect(world, &x, &y, &w, &h)) return;
+    int b = world->border;
+    world->min_living_x = min(world->min_living_x, x + b);
+    world->min_living_y = min(world->min_living_y, y + b);
+    world->max_living_x = max(world->max_living_x, x + w - 1 + b);
+    world->max_living_y = max(world->max_living_y, y + h - 1 + b);
+}
+
+static inline unsigned char *cell_ptr(World *world, int x, int y) {
+    return world->current_world + (y + world->border) * world->stride + (x + world->border);
+}
+
+static void fill_span(World *world, int y, int x0, int x1, unsigned char value) {
+    if (y < 0 || y >= (int)world->height) return;
+    x0 = max(x0, 0);
+    x1 = min(x1, (int)world->width - 1);
+    if (x0 > x1) return;
+    memset(cell_ptr(world, x0, y), value, x1 - x0 + 1);
+}
+
+static void stamp_brush(World *world, int x, int y, int radius, unsigned char value) {
+    for (int dy = -radius; dy <= radius; dy++) {
+        int half = (int)sqrtf((float)(radius * radius - dy * dy));
+        fill_span(world, y + dy, x - half, x + half, value);
+    }
+}
+
+void paint_brush(World *world, int x, int y, uint radius, unsigned char value) {
+    stamp_brush(world, x, y, radius, value);
+    touch_rect(world, x - (int)radius, y - (int)radius, 2 * radius + 1, 2 * radius + 1, value);
+}
+
+void paint_line(World *world, int x0, int y0, int x1, int y1, uint radius, unsigned char value) {
+    // Bresenham, a brush stamp on every point so fast strokes have no gaps
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    int x = x0, y = y0;
+    while (1) {
+        stamp_brush(world, x, y, radius, value);
+        if (x == x1 && y == y1) break;
+        int e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x += sx; }
+        if (e2 <= dx) { err += dx; y += sy; }
+    }
+    int r = radius;
+    touch_rect(world, min(x0, x1) - r, min(y0, y1) - r, abs(x1 - x0) + 2 * r + 1, abs(y1 - y0) + 2 * r + 1, value);
+}
+
+void fill_rect(World *world, int x, int y, int w, int h, unsigned char value) {
+    if (!clip_rect(world, &x, &y, &w, &h)) return;
+    for (int i = 0; i < h; i++) {
+        memset(cell_ptr(world, x, y + i), value, w);
+    }
+    touch_rect(world, x, y, w, h, value);
+}
+
+void copy_region(World *world, int x, int y, int w, int h, Pattern *pattern) {
+    free_pattern(pattern);
+    if (!clip_rect(world, &x, &y, &w, &h)) return;
+    pattern->width = w;
+    pattern->height = h;
+    pattern->cells = (unsigned char*) malloc(w * h);
+    for (int i = 0; i < h; i++) {
+        memcpy(pattern->cells + i * w, cell_ptr(world, x, y + i), w);
+    }
+}
+
+void paste_pattern(World *world, const Pattern *pattern, int x, int y, unsigned char mode) {
+    if (!pattern->cells) return;
+    int w = pattern->width, h = pattern->height;
+    int dst_x = x, dst_y = y;
+    if (!clip_rect(world, &dst_x, &dst_y, &w, &h)) return;
+    int src_x = dst_x - x, src_y = dst_y - y;
+    for (int i = 0; i < h; i++) {
+        const unsigned char *src = pattern->cells + (src_y + i) * pattern->width + src_x;
+        unsigned char *dst = cell_ptr(world, dst_x, dst_y + i);
+        if (mode == PASTE_STAMP) {
+            for (int j = 0; j < w; j++) {
+                dst[j] = src[j] ? src[j] : dst[j];
+            }
+        } else {
+            memcpy(dst, src, w);
+        }
+    }
+    touch_rect(world, dst_x, dst_y, w, h, 1);
+}
+
+// clockwise
+void rotate_pattern(Pattern *pattern) {
+    if (!pattern->cells) return;
+    uint w = pattern->width, h = pattern->height;
+    unsigned char *rotated = (unsigned char*) malloc(w * h);
+    for (uint i = 0; i < h; i++) {
+        const unsigned char *src = pattern->cells + i * w;
+        for (uint j = 0; j < w; j++) {
+            rotated[j * h + (h - 1 - i)] = src[j];
+        }
+    }
+    free(pattern->cells);
+    pattern->cells = rotated;
+    pattern->width = h;
+    pattern->height = w;
+}
+
+void flip_pattern(Pattern *pattern, unsigned char vertical) {
+    if (!pattern->cells) return;
+    uint w = pattern->width, h = pattern->height;
+    if (vertical) {
+        unsigned char *row = (unsigned char*) malloc(w);
+        for (uint i = 0; i < h / 2; i++) {
+            unsigned char *top = pattern->cells + i * w;
+            unsigned char *bottom = pattern->cells + (h - 1 - i) * w;
+            memcpy(row, top, w);
+            memcpy(top, bottom, w);
+            memcpy(bottom, row, w);
+        }
+        free(row);
+    } else {
+        for (uint i = 0; i < h; i++) {
+            unsigned char *row = pattern->cells + i * w;
+            for (uint j = 0; j < w / 2; j++) {
+                unsigned char temp = row[j];
+                row[j] = row[w - 1 - j];
+                row[w - 1 - j] = temp;
+            }
+        }
+    }
+}
+
+void free_pattern(Pattern *pattern) {
+    if (pattern->cells) free(pattern->cells);
+    pattern->cells = NULL;
+    pattern->width = 0;
+    pattern->height = 0;
+}
@@ -0,0 +1,27 @@
+// edit.h
+#ifndef EDIT_H
+#define EDIT_H
+
+#include "world.h"
+
+// Прямоугольный фрагмент мира (буфер обмена, шаблон)
+typedef struct {
+    unsigned int width, height;
+    unsigned char *cells;       // width * height, без призрачных ячеек
+} Pattern;
+
+#define PASTE_REPLACE 0         // Фрагмент полностью заменяет область
+#define PASTE_STAMP 1           // Переносятся только живые клетки
+
+// Координаты - клетки мира, начиная с 0. Всё, что выходит за границы, обрезается.
+void paint_brush(World *world, int x, int y, unsigned int radius, unsigned char value);
+void paint_line(World *world, int x0, int y0, int x1, int y1, unsigned int radius, unsigned char value);
+void fill_rect(World *world, int x, int y, int w, int h, unsigned char value);
+
+void copy_region(World *world, int x, int y, int w, int h, Pattern *pattern);
+void paste_pattern(World *world, const Pattern *pattern, int x, int y, unsigned char mode);
+void rotate_pattern(Pattern *pattern);
+void flip_pattern(Pattern *pattern, unsigned char vertical);
+void free_pattern(Pattern *pattern);
+
+#endif
@@ -0,0 +1,264 @@
+// history.c
+#include "history.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "world.h"
+
+void init_history(History *history) {
+    if (history->keyframe_interval == 0) history->keyframe_interval = 1;
+    if (history->capacity == 0) history->capacity = 1;
+    history->entries = (HistoryEntry*) calloc(history->capacity, sizeof(HistoryEntry));
+    history->head = 0;
+    history->count = 0;
+    history->used_bytes = 0;
+    history->since_keyframe = 0;
+    history->since_keyframe_bytes = 0;
+    history->width = 0;
+    history->height = 0;
+    history->shadow = NULL;
+    history->scratch_changed = NULL;
+    history->scratch_values = NULL;
+}
+
+static HistoryEntry *entry_at(History *history, uint i) {
+    return &history->entries[(history->head + i) % history->capacity];
+}
+
+static void free_entry(History *history, HistoryEntry *entry) {
+    free(entry->keyframe);
+    free(entry->changed);
+    free(entry->values);
+    history->used_bytes -= entry->bytes;
+    memset(entry, 0, sizeof(*entry));
+}
+
+void free_history(History *history) {
+    if (history->entries) {
+        for (uint i = 0; i < history->count; i++) {
+            free_entry(history, entry_at(history, i));
+        }
+        free(history->entries);
+    }
+    free(history->shadow);
+    free(history->scratch_changed);
+    free(history->scratch_values);
+    history->entries = NULL;
+    history->shadow = NULL;
+    history->scratch_changed = NULL;
+    history->scratch_values = NULL;
+    history->count = 0;
+}
+
+// the oldest entry is always a keyframe, so dropping it drops its diffs too
+static void evict_oldest_group(History *history) {
+    do {
+        free_entry(history, entry_at(history, 0));
+        history->head = (history->head + 1) % history->capacity;
+        history->count--;
+    } while (history->count > 0 && !entry_at(history, 0)->keyframe);
+}
+
+static uint latest_keyframe(History *history) {
+    uint i = history->count - 1;
+    while (i > 0 && !entry_at(history, i)->keyframe) i--;
+    return i;
+}
+
+static void copy_interior(unsigned char *dst, const World *world) {
+    for (uint y = 0; y < world->height; y++) {
+        memcpy(dst + y * world->width, world->current_world + (y + world->border) * world->stride + world->border, world->width);
+    }
+}
+
+// keep at least the group that the newest entry belongs to
+static void enforce_budget(History *history) {
+    while (history->used_bytes > history->budget_bytes && latest_keyframe(history) > 0) {
+        evict_oldest_group(history);
+    }
+}
+
+// folds the changes of a repeated record (an edit without a step) into the newest entry
+static void merge_entry(History *history, HistoryEntry *entry, uint count, unsigned char overflow, uint max_changed) {
+    uint size = history->width * history->height;
+    if (entry->keyframe) {
+        memcpy(entry->keyframe, history->shadow, size);
+        return;
+    }
+
+    // both lists are sorted by index, newer values win
+    unsigned int *changed = (unsigned int*) malloc((entry->count + count) * sizeof(*changed));
+    unsigned char *values = (unsigned char*) malloc(entry->count + count);
+    uint n = 0, a = 0, b = 0;
+    while (!overflow && (a < entry->count || b < count)) {
+        if (b == count || (a < entry->count && entry->changed[a] < history->scratch_changed[b])) {
+            changed[n] = entry->changed[a];
+            values[n++] = entry->values[a++];
+        } else {
+            if (a < entry->count && entry->changed[a] == history->scratch_changed[b]) a++;
+            changed[n] = history->scratch_changed[b];
+            values[n++] = history->scratch_values[b++];
+        }
+    }
+    history->used_bytes -= entry->bytes;
+    history->since_keyframe_bytes -= entry->bytes;
+    free(entry->changed);
+    free(entry->values);
+    if (overflow || n > max_changed) { // the entry becomes a keyframe of the edited state
+        free(changed);
+        free(values);
+        entry->changed = NULL;
+        entry->values = NULL;
+        entry->count = 0;
+        entry->keyframe = (unsigned char*) malloc(size);
+        memcpy(entry->keyframe, history->shadow, size);
+        entry->bytes = size;
+        history->since_keyframe = 1;
+        history->since_keyframe_bytes = 0;
+    } else {
+        entry->changed = changed;
+        entry->values = values;
+        entry->count = n;
+        entry->bytes = n * (sizeof(*changed) + sizeof(*values));
+        history->since_keyframe_bytes += entry->bytes;
+    }
+    history->used_bytes += entry->bytes;
+    enforce_budget(history);
+}
+
+void record_history(History *history, World *world, long generation) {
+    uint size = world->width * world->height;
+    uint max_changed = size / (sizeof(*history->scratch_changed) + sizeof(*history->scratch_values));
+    uint count = 0;
+    unsigned char overflow = 0;
+
+    if (!history->shadow || history->width != world->width || history->height != world->height) {
+        // first record or the world was recreated with another size
+        free_history(history);
+        init_history(history);
+        history->width = world->width;
+        history->height = world->height;
+        history->shadow = (unsigned char*) malloc(size);
+        history->scratch_changed = (unsigned int*) malloc(max_changed * sizeof(*history->scratch_changed));
+        history->scratch_values = (unsigned char*) malloc(max_changed);
+        copy_interior(history->shadow, world);
+        live_bounds(world, &history->live_x0, &history->live_y0, &history->live_x1, &history->live_y1);
+    } else {
+        // only cells alive before or after can differ, everything else stays dead
+        int x0 = history->live_x0, y0 = history->live_y0;
+        int x1 = history->live_x1, y1 = history->live_y1;
+        live_bounds(world, &history->live_x0, &history->live_y0, &history->live_x1, &history->live_y1);
+        if (x0 >= x1 || y0 >= y1) {
+            x0 = history->live_x0; y0 = history->live_y0;
+            x1 = history->live_x1; y1 = history->live_y1;
+        } else if (history->live_x0 < history->live_x1 && history->live_y0 < history->live_y1) {
+            if (history->live_x0 < x0) x0 = history->live_x0;
+            if (history->live_y0 < y0) y0 = history->live_y0;
+            if (history->live_x1 > x1) x1 = history->live_x1;
+            if (history->live_y1 > y1) y1 = history->live_y1;
+        }
+
+        // diff against the last recorded state, changed cells are written back to shadow
+        for (int y = y0; y < y1; y++) {
+            unsigned char *row = world->current_world + (y + world->border) * world->stride + world->border;
+            unsigned char *old = history->shadow + y * world->width;
+            if (memcmp(row + x0, old + x0, x1 - x0) == 0) continue;
+            for (int x = x0; x < x1; x++) {
+                if (row[x] == old[x]) continue;
+                old[x] = row[x];
+                if (count == max_changed) {
+                    overflow = 1; // diff is bigger than a keyframe
+                    continue;
+                }
+                history->scratch_changed[count] = y * world->width + x;
+                history->scratch_values[count] = row[x];
+                count++;
+            }
+        }
+    }
+
+    if (history->count > 0) {
+        HistoryEntry *newest = entry_at(history, history->count - 1);
+        if (!overflow && count == 0) return; // nothing changed, nothing to remember
+        if (newest->generation == generation) {
+            merge_entry(history, newest, count, overflow, max_changed);
+            return;
+        }
+    }
+
+    // evict first, so the new entry knows whether a keyframe is still there
+    if (history->count == history->capacity) {
+        evict_oldest_group(history);
+    }
+
+    // A keyframe every K generations, but only once replaying the diffs since the last one
+    // would cost about as much as copying a keyframe: sparse worlds would otherwise pay
+    // for a full snapshot every K generations. At least two groups fit into the capacity.
+    unsigned char keyframe = overflow || history->count == 0 || history->since_keyframe >= history->capacity / 2
+        || (history->since_keyframe >= history->keyframe_interval && history->since_keyframe_bytes >= size);
+    HistoryEntry entry = {0};
+    entry.generation = generation;
+    if (keyframe) {
+        entry.keyframe = (unsigned char*) malloc(size);
+        memcpy(entry.keyframe, history->shadow, size);
+        entry.bytes = size;
+        history->since_keyframe = 0;
+        history->since_keyframe_bytes = 0;
+    } else {
+        entry.count = count;
+        if (count) {
+            entry.changed = (unsigned int*) malloc(count * sizeof(*entry.changed));
+            entry.values = (unsigned char*) malloc(count);
+            memcpy(entry.changed, history->scratch_changed, count * sizeof(*entry.changed));
+            memcpy(entry.values, history->scratch_values, count);
+        }
+        entry.bytes = count * (sizeof(*entry.changed) + sizeof(*entry.values));
+        history->since_keyframe_bytes += entry.bytes;
+    }
+    history->since_keyframe++;
+
+    *entry_at(history, history->count) = entry;
+    history->count++;
+    history->used_bytes += entry.bytes;
+    enforce_budget(history);
+}
+
+long oldest_history(History *history) {
+    if (history->count == 0) return -1;
+    return entry_at(history, 0)->generation;
+}
+
+long seek_history(History *history, World *world, long generation) {
+    if (history->count == 0 || entry_at(history, 0)->generation > generation) return -1;
+
+    // last entry not newer than the requested generation
+    uint target = history->count - 1;
+    while (target > 0 && entry_at(history, target)->generation > generation) target--;
+    uint key = target;
+    while (key > 0 && !entry_at(history, key)->keyframe) key--;
+
+    // replay from the nearest keyframe
+    memcpy(history->shadow, entry_at(history, key)->keyframe, history->width * history->height);
+    history->since_keyframe_bytes = 0;
+    for (uint i = key + 1; i <= target; i++) {
+        HistoryEntry *entry = entry_at(history, i);
+        history->since_keyframe_bytes += entry->bytes;
+        for (uint c = 0; c < entry->count; c++) {
+            history->shadow[entry->changed[c]] = entry->values[c];
+        }
+    }
+    for (uint y = 0; y < world->height; y++) {
+        memcpy(world->current_world + (y + world->border) * world->stride + world->border, history->shadow + y * world->width, world->width);
+    }
+    full_bounds(world);
+    live_bounds(world, &history->live_x0, &history->live_y0, &history->live_x1, &history->live_y1);
+
+    // the future is rewritten from here on
+    while (history->count > target + 1) {
+        free_entry(history, entry_at(history, history->count - 1));
+        history->count--;
+    }
+    history->since_keyframe = target - key + 1;
+    return entry_at(history, target)->generation;
+}
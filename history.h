@@ -0,0 +1,42 @@
+// history.h
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "world.h"
+
+typedef struct {
+    long generation;            // Номер поколения
+    unsigned char *keyframe;    // Полная копия мира (width * height) или NULL
+    unsigned int *changed;      // Индексы изменившихся клеток (y * width + x)
+    unsigned char *values;      // Новые значения изменившихся клеток
+    unsigned int count;         // Количество изменившихся клеток
+    unsigned long bytes;        // Занимаемая память
+} HistoryEntry;
+
+typedef struct {
+    // Параметры (задаются до init_history)
+    unsigned int keyframe_interval; // Полный снимок не чаще, чем раз в K поколений
+    unsigned long budget_bytes;     // Ограничение памяти
+    unsigned int capacity;          // Максимальное число записей
+
+    HistoryEntry *entries;      // Кольцевой буфер
+    unsigned int head;          // Индекс самой старой записи
+    unsigned int count;
+    unsigned long used_bytes;
+    unsigned int since_keyframe;
+    unsigned long since_keyframe_bytes; // Размер разностей после последнего снимка
+
+    unsigned int width, height;
+    unsigned char *shadow;      // Состояние на момент последней записи
+    int live_x0, live_y0, live_x1, live_y1; // Где могут быть живые клетки в shadow
+    unsigned int *scratch_changed;
+    unsigned char *scratch_values;
+} History;
+
+void init_history(History *history);
+void free_history(History *history);
+void record_history(History *history, World *world, long generation);
+long seek_history(History *history, World *world, long generation);
+long oldest_history(History *history);
+
+#endif
@@ -1,12 +1,14 @@
 // life_raylib.c
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include "raylib.h"
 #include "raymath.h"
 
 #include "world.h"
 #include "simulation.h"
 #include "draw.h"
+#include "edit.h"
 #include "util.h"
 
 
@@ -15,6 +17,8 @@
 
 #define CELL_SIZE 1
 #define TARGET_SPS 60.0f
+#define MAX_SPS 1e6f
+#define STEP_BUDGET 0.010f   // время на шаги за кадр (сек), остальное - на отрисовку
 
 #define TYPES 2
 const Color COLORS[] = {
@@ -24,30 +28,94 @@ const Color COLORS[] = {
 
 #define MAX_WORLD_SIZE 1024
 
+#define HISTORY_KEYFRAME_INTERVAL 64
+#define HISTORY_BUDGET (256ul * 1024 * 1024)
+#define HISTORY_CAPACITY 4096
+#define REWIND_FAST 100
+
+#define MAX_BRUSH_RADIUS 64
+
 uint state = 0; // 0 - menu, 1 - sim
 
 Simulation sim;
 
+#define RULE_CONWAY 0
+#define RULE_BOSCO 1        // R5,C0,M1,S34..58,B34..45,NM
+#define RULE_VON_NEUMANN 2  // R2,C0,M0,S2..4,B3..3,NN
+#define RULE_COUNT 3
+
+static void set_rule(World *world, unsigned char rule) {
+    switch (rule) {
+        case RULE_BOSCO: {
+            world->radius = 5;
+            world->neighborhood = NEIGHBORHOOD_MOORE;
+            world->count_self = 1;
+            world->birth_min = 34;
+            world->birth_max = 45;
+            world->survive_min = 34;
+            world->survive_max = 58;
+        } break;
+        case RULE_VON_NEUMANN: {
+            world->radius = 2;
+            world->neighborhood = NEIGHBORHOOD_VON_NEUMANN;
+            world->count_self = 0;
+            world->birth_min = 3;
+            world->birth_max = 3;
+            world->survive_min = 2;
+            world->survive_max = 4;
+        } break;
+        default: {
+            world->radius = 1;
+            world->neighborhood = NEIGHBORHOOD_MOORE;
+            world->count_self = 0;
+            world->birth_min = 3;
+            world->birth_max = 3;
+            world->survive_min = 2;
+            world->survive_max = 3;
+        } break;
+    }
+}
+
+static void mouse_to_cell(Camera2D camera, int *x, int *y) {
+    Vector2 mousePos = GetMousePosition();
+    *x = (int)floorf((mousePos.x - camera.offset.x) / camera.zoom + camera.target.x);
+    *y = (int)floorf((mousePos.y - camera.offset.y) / camera.zoom + camera.target.y);
+}
+
 int main() {
     char text_buffer[128]; 
 
     bool dragging = false;
     Vector2 lastMousePosition = {0};
 
+    uint brush = 0;
+    bool painting = false;
+    int last_cell_x = 0, last_cell_y = 0;
+    bool selecting = false;
+    bool selected = false;
+    int sel_x0 = 0, sel_y0 = 0, sel_x1 = 0, sel_y1 = 0;
+    Pattern clipboard = {0};
+
 
     uint size = 32;
 
     sim.world.width = 2048; sim.world.height = 2048;
-    init_world(&sim.world);
+    sim.history.keyframe_interval = HISTORY_KEYFRAME_INTERVAL;
+    sim.history.budget_bytes = HISTORY_BUDGET;
+    sim.history.capacity = HISTORY_CAPACITY;
+    sim.max_speed = TARGET_SPS;
+    sim.frame_budget = STEP_BUDGET;
+    init_sim(&sim);
     // rand_world(&sim.world);
     uint x = sim.world.width / 2 - 2;
     uint y = sim.world.height / 2 - 2;
 
-    sim.world.current_world[(y + 1) * sim.world.stride + x + 2] = 1;
-    sim.world.current_world[(y + 2) * sim.world.stride + x + 3] = 1;
-    sim.world.current_world[(y + 3) * sim.world.stride + x + 1] = 1;
-    sim.world.current_world[(y + 3) * sim.world.stride + x + 2] = 1;
-    sim.world.current_world[(y + 3) * sim.world.stride + x + 3] = 1;
+    set_cell(&sim.world, x + 1, y, 1);
+    set_cell(&sim.world, x + 2, y + 1, 1);
+    set_cell(&sim.world, x, y + 2, 1);
+    set_cell(&sim.world, x + 1, y + 2, 1);
+    set_cell(&sim.world, x + 2, y + 2, 1);
+    record_simulation(&sim);
     state = 1;
     Camera2D camera = { 0 };
     camera.target = (Vector2){ sim.world.width / 2, sim.world.height / 2 };     // What point in world space the camera looks at
@@ -73,16 +141,34 @@ int main() {
     unsigned char rendering = 1;  
     unsigned char grid = 1;  
     unsigned char full_redraw = 1;  
+    unsigned char edited = 0;
+    unsigned char rule = RULE_CONWAY;
+    CellRect last_view = {0};
+    CellRect last_live = {0};
     while (!WindowShouldClose()) {
         float frametime = GetFrameTime();
-        if (sim.running) {
-            step_simulation(&sim);
+        if (run_simulation(&sim, frametime)) {
             changed = 1;
         }
         if (IsKeyPressed(KEY_F)) {
             step_simulation(&sim);
             changed = 1;
         }
+        if (IsKeyPressed(KEY_EQUAL) && sim.max_speed > 0) {
+            sim.max_speed *= 2;
+            if (sim.max_speed > MAX_SPS) sim.max_speed = 0; // без ограничения
+        }
+        if (IsKeyPressed(KEY_MINUS)) {
+            sim.max_speed = sim.max_speed > 0 ? sim.max_speed / 2 : MAX_SPS;
+            if (sim.max_speed < 1) sim.max_speed = 1;
+        }
+        if (IsKeyPressed(KEY_B)) {
+            unsigned char shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+            if (rewind_simulation(&sim, shift ? REWIND_FAST : 1) >= 0) {
+                full_redraw = 1;
+                changed = 1;
+            }
+        }
 
         if (IsKeyDown(KEY_RIGHT)) camera.target.x += 600.0f / camera.zoom * frametime;
         if (IsKeyDown(KEY_LEFT)) camera.target.x -= 600.0f / camera.zoom * frametime;
@@ -135,12 +221,21 @@ int main() {
         }
 
         if (IsKeyPressed(KEY_N)) {
-            free_world(&sim.world);
+            free_sim(&sim);
             init_sim(&sim);
             changed = 1;
         }
+        if (IsKeyPressed(KEY_L)) { // рамка мира зависит от радиуса, поэтому мир создаётся заново
+            free_sim(&sim);
+            rule = (rule + 1) % RULE_COUNT;
+            set_rule(&sim.world, rule);
+            init_sim(&sim);
+            full_redraw = 1;
+            changed = 1;
+        }
         if (IsKeyPressed(KEY_R)) {
             rand_world(&sim.world, TYPES);
+            record_simulation(&sim);
             changed = 1;
         }
 
@@ -164,50 +259,123 @@ int main() {
             lastMousePosition = currentMouse;
         }
 
-        if(IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
-            Vector2 mousePos = GetMousePosition();
-            mousePos.x = (mousePos.x - camera.offset.x) / camera.zoom + camera.target.x;
-            mousePos.y = (mousePos.y - camera.offset.y) / camera.zoom + camera.target.y;
-            set_cell(&sim.world, mousePos.x, mousePos.y, 1);
-            changed = 1;
+        bool ctrl = IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
+        bool shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+        int cell_x, cell_y;
+        mouse_to_cell(camera, &cell_x, &cell_y);
+
+        if (IsKeyPressed(KEY_RIGHT_BRACKET) && brush < MAX_BRUSH_RADIUS) brush++;
+        if (IsKeyPressed(KEY_LEFT_BRACKET) && brush > 0) brush--;
+
+        // Selection: Ctrl + LMB drag
+        if (ctrl && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+            selecting = true;
+            selected = true;
+            sel_x0 = sel_x1 = cell_x;
+            sel_y0 = sel_y1 = cell_y;
+        }
+        if (selecting) {
+            sel_x1 = cell_x;
+            sel_y1 = cell_y;
+            if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) selecting = false;
+        }
+        int sel_x = min(sel_x0, sel_x1), sel_y = min(sel_y0, sel_y1);
+        int sel_w = abs(sel_x1 - sel_x0) + 1, sel_h = abs(sel_y1 - sel_y0) + 1;
+
+        // Strokes are interpolated between frames, a whole stroke is recorded once when it ends
+        unsigned char value = IsMouseButtonDown(MOUSE_BUTTON_LEFT) ? 1 : 0;
+        if (!selecting && (IsMouseButtonDown(MOUSE_BUTTON_LEFT) || IsMouseButtonDown(MOUSE_BUTTON_RIGHT))) {
+            if (!painting || cell_x != last_cell_x || cell_y != last_cell_y) {
+                if (!painting) {
+                    last_cell_x = cell_x;
+                    last_cell_y = cell_y;
+                    painting = true;
+                }
+                paint_line(&sim.world, last_cell_x, last_cell_y, cell_x, cell_y, brush, value);
+                last_cell_x = cell_x;
+                last_cell_y = cell_y;
+                changed = 1;
+            }
+        } else if (painting) {
+            painting = false;
+            edited = 1;
         }
 
-        if(IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
-            Vector2 mousePos = GetMousePosition();
-            mousePos.x = (mousePos.x - camera.offset.x) / camera.zoom + camera.target.x;
-            mousePos.y = (mousePos.y - camera.offset.y) / camera.zoom + camera.target.y;
-            set_cell(&sim.world, mousePos.x, mousePos.y, 0);
+        if (selected && IsKeyPressed(KEY_C)) {
+            copy_region(&sim.world, sel_x, sel_y, sel_w, sel_h, &clipboard);
+        }
+        if (selected && IsKeyPressed(KEY_X)) {
+            copy_region(&sim.world, sel_x, sel_y, sel_w, sel_h, &clipboard);
+            fill_rect(&sim.world, sel_x, sel_y, sel_w, sel_h, 0);
+            edited = 1;
+        }
+        if (selected && (IsKeyPressed(KEY_DELETE) || IsKeyPressed(KEY_BACKSPACE))) {
+            fill_rect(&sim.world, sel_x, sel_y, sel_w, sel_h, 0);
+            edited = 1;
+        }
+        if (selected && IsKeyPressed(KEY_E)) {
+            fill_rect(&sim.world, sel_x, sel_y, sel_w, sel_h, 1);
+            edited = 1;
+        }
+        if (IsKeyPressed(KEY_V)) {
+            paste_pattern(&sim.world, &clipboard, cell_x, cell_y, shift ? PASTE_STAMP : PASTE_REPLACE);
+            edited = 1;
+        }
+        if (IsKeyPressed(KEY_T)) rotate_pattern(&clipboard);
+        if (IsKeyPressed(KEY_H)) flip_pattern(&clipboard, shift);
+
+        if (edited) {
+            record_simulation(&sim);
             changed = 1;
+            edited = 0;
         }
 
+        // Only the part of the world the camera sees is coloured and uploaded
+        CellRect view = visible_cells(&sim.world, camera, CELL_SIZE, GetScreenWidth(), GetScreenHeight());
+        bool view_moved = view.x != last_view.x || view.y != last_view.y || view.w != last_view.w || view.h != last_view.h;
         BeginDrawing();
-        if (rendering) {
+        if (rendering && (changed || full_redraw || view_moved)) {
             // printf("rendering world...\n");`
-            draw_world(&sim.world, pixelBuffer, COLORS, full_redraw);        
-            UpdateTexture(texture, pixelBuffer);
+            CellRect live = live_cells(&sim.world);
+            CellRect region = view;
+            if (!full_redraw && !view_moved) {
+                region = clip_cells(union_cells(last_live, live), view);
+            }
+            if (region.w > 0 && region.h > 0) {
+                draw_world(&sim.world, pixelBuffer, COLORS, region);
+                UpdateTextureRec(texture, (Rectangle){ region.x, region.y, region.w, region.h }, pixelBuffer);
+            }
+            last_live = live;
+            last_view = view;
         }
         BeginMode2D(camera); 
             ClearBackground(DARKGRAY);
             
             DrawTexturePro(
             texture,
-            (Rectangle){ 0, 0, texture.width, texture.height }, // flip vertically
-            (Rectangle){ 0, 0, texture.width * CELL_SIZE, texture.height * CELL_SIZE },
+            (Rectangle){ view.x, view.y, view.w, view.h }, // flip vertically
+            (Rectangle){ view.x * CELL_SIZE, view.y * CELL_SIZE, view.w * CELL_SIZE, view.h * CELL_SIZE },
             (Vector2){ 0, 0 },
             0.0f,
             WHITE
         ); 
+        if (selected) {
+            DrawRectangleLinesEx((Rectangle){ sel_x * CELL_SIZE, sel_y * CELL_SIZE, sel_w * CELL_SIZE, sel_h * CELL_SIZE }, 2.0f / camera.zoom, BLUE);
+        }
         if (grid && camera.zoom > 5) {
-            for (uint y = 0; y <= sim.world.height; y++) {
-                DrawLine(0, y*CELL_SIZE, sim.world.width, y*CELL_SIZE, GRAY);
+            for (int y = view.y; y <= view.y + view.h; y++) {
+                DrawLine(view.x*CELL_SIZE, y*CELL_SIZE, (view.x + view.w)*CELL_SIZE, y*CELL_SIZE, GRAY);
             }
-            for (uint x = 0; x <= sim.world.width; x++) {
-                DrawLine(x*CELL_SIZE, 0, x*CELL_SIZE, sim.world.height, GRAY);
+            for (int x = view.x; x <= view.x + view.w; x++) {
+                DrawLine(x*CELL_SIZE, view.y*CELL_SIZE, x*CELL_SIZE, (view.y + view.h)*CELL_SIZE, GRAY);
             }
         }
 
         EndMode2D(); 
-        sprintf(text_buffer, "FPS: %d\nZoom: %.2f\nIterations: %ld\n%c %c", GetFPS(), camera.zoom, sim.total_iterations, sim.running ? ' ' : 'P', rendering ? 'R' : ' ');
+        char speed_cap[32];
+        if (sim.max_speed > 0) sprintf(speed_cap, "%.0f", sim.max_speed);
+        else sprintf(speed_cap, "max");
+        sprintf(text_buffer, "FPS: %d\nZoom: %.2f\nIterations: %ld\nSpeed: %.0f / %s gen/s\nBrush: %u\n%c %c", GetFPS(), camera.zoom, sim.total_iterations, sim.current_speed, speed_cap, brush * 2 + 1, sim.running ? ' ' : 'P', rendering ? 'R' : ' ');
         DrawText(text_buffer, 10, 10, 20, BLACK);
         EndDrawing();
 
@@ -216,7 +384,8 @@ int main() {
     }
 
     CloseWindow();
-    free_world(&sim.world);
+    free_sim(&sim);
+    free_pattern(&clipboard);
     free(pixelBuffer);
 
     return 0;
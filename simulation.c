@@ -1,11 +1,32 @@
 // simulation.c
 #include "simulation.h"
 #include "world.h"
+#include "history.h"
+#include <time.h>
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
 void init_sim(Simulation *sim) {
+    if (sim->frame_budget <= 0) sim->frame_budget = DEFAULT_FRAME_BUDGET;
     init_world(&sim->world);
+    init_history(&sim->history);
     sim->running = 0;
     sim->total_iterations = 0;
+    sim->current_speed = 0;
+    sim->time_credit = 0;
+    sim->step_credit = 0;
+    sim->last_measure_time = now_seconds();
+    sim->iterations_since_measure = 0;
+    record_simulation(sim);
+}
+
+void free_sim(Simulation *sim) {
+    free_world(&sim->world);
+    free_history(&sim->history);
 }
 
 void step_simulation(Simulation* sim) {
@@ -14,4 +35,61 @@ void step_simulation(Simulation* sim) {
     
     // Обновление статистики
     sim->total_iterations++;
-}
\ No newline at end of file
+    sim->iterations_since_measure++;
+
+    record_simulation(sim);
+}
+
+// Выполняет столько шагов, сколько помещается в frame_budget (только шаги, отрисовка
+// в бюджет не входит). Если шаг дольше бюджета, перерасход отдаётся следующими
+// кадрами и шаг делается не каждый кадр.
+// Возвращает количество выполненных шагов.
+unsigned int run_simulation(Simulation* sim, double frametime) {
+    double now = now_seconds();
+    if (now - sim->last_measure_time >= 1.0) {
+        sim->current_speed = sim->iterations_since_measure / (now - sim->last_measure_time);
+        sim->last_measure_time = now;
+        sim->iterations_since_measure = 0;
+    }
+    if (!sim->running) {
+        sim->time_credit = 0;
+        sim->step_credit = 0;
+        return 0;
+    }
+
+    sim->time_credit += sim->frame_budget;
+    if (sim->max_speed > 0) {
+        sim->step_credit += frametime * sim->max_speed;
+        if (sim->step_credit > sim->max_speed) sim->step_credit = sim->max_speed; // не больше секунды долга
+    }
+
+    unsigned int steps = 0;
+    while (sim->time_credit > 0) {
+        if (sim->max_speed > 0 && sim->step_credit < 1.0) break;
+        double start = now_seconds();
+        step_simulation(sim);
+        double elapsed = now_seconds() - start;
+        sim->time_credit -= elapsed;
+        if (sim->max_speed > 0) sim->step_credit -= 1.0;
+        steps++;
+    }
+    // неизрасходованное из-за ограничения скорости время не копится
+    if (sim->time_credit > sim->frame_budget) sim->time_credit = sim->frame_budget;
+    return steps;
+}
+
+// Запоминает текущее состояние (после шага или ручного редактирования)
+void record_simulation(Simulation* sim) {
+    record_history(&sim->history, &sim->world, sim->total_iterations);
+}
+
+// Возвращает номер поколения, на которое удалось перемотать, или -1
+long rewind_simulation(Simulation* sim, long generations) {
+    long target = sim->total_iterations - generations;
+    long oldest = oldest_history(&sim->history);
+    if (oldest < 0) return -1;
+    if (target < oldest) target = oldest;
+    long generation = seek_history(&sim->history, &sim->world, target);
+    if (generation >= 0) sim->total_iterations = generation;
+    return generation;
+}
@@ -3,20 +3,36 @@
 #define SIMULATION_H
 
 #include "world.h"
+#include "history.h"
+
+#define DEFAULT_FRAME_BUDGET 0.010  // Бюджет на шаги по умолчанию (сек)
 
 typedef struct {
     World world;                // Состояние игрового мира
+    History history;            // История поколений для перемотки назад
     
     // Параметры симуляции
     unsigned int delay_us;      // Задержка между шагами (мкс)
     double current_speed;       // Текущая скорость (итераций/сек)
+    double max_speed;           // Ограничение скорости (итераций/сек), 0 - без ограничения
+    double frame_budget;        // Время только на шаги за один кадр (сек), без отрисовки
     unsigned char running;
+
+    // Планировщик
+    double time_credit;         // Накопленное время на шаги (сек)
+    double step_credit;         // Накопленные шаги при ограничении скорости
+    double last_measure_time;
+    long iterations_since_measure;
     
     // Статистика
     long total_iterations;      // Общее количество итераций
 } Simulation;
 
 void init_sim(Simulation *sim);
+void free_sim(Simulation *sim);
 void step_simulation(Simulation* sim);
+unsigned int run_simulation(Simulation* sim, double frametime);
+void record_simulation(Simulation* sim);
+long rewind_simulation(Simulation* sim, long generations);
 
 #endif
\ No newline at end of file
@@ -7,51 +7,93 @@
 #include "util.h"
 
 void init_world(World *world) {
-    world->stride = world->width + 2;
-    world->world_1 = (unsigned char*) malloc(world->stride * (world->height + 2) * sizeof(unsigned char));
-    world->world_2 = (unsigned char*) malloc(world->stride * (world->height + 2) * sizeof(unsigned char));
+    if (world->radius == 0) world->radius = 1;
+    if (world->birth_max == 0 && world->survive_max == 0) { // B3/S23
+        world->birth_min = 3;
+        world->birth_max = 3;
+        world->survive_min = 2;
+        world->survive_max = 3;
+    }
+    world->border = world->radius;
+    world->stride = world->width + 2 * world->border;
+    uint rows = world->height + 2 * world->border;
+    world->world_1 = (unsigned char*) malloc(world->stride * rows * sizeof(unsigned char));
+    world->world_2 = (unsigned char*) malloc(world->stride * rows * sizeof(unsigned char));
     world->current_world = world->world_1;
     world->next_world = world->world_2;
-    world->min_living_x = 1;
-    world->min_living_y = 1;
-    world->max_living_x = world->width;
-    world->max_living_y = world->height;
+    world->sums = NULL;
+    if (world->neighborhood == NEIGHBORHOOD_VON_NEUMANN) { // diagonal prefix sums, padded by 1
+        world->sums = (unsigned int*) calloc(2 * (world->stride + 2) * (rows + 2), sizeof(unsigned int));
+    } else if (world->radius > 1) { // column sums
+        world->sums = (unsigned int*) calloc(world->stride, sizeof(unsigned int));
+    }
+    full_bounds(world);
     
-    memset(world->current_world, 0, (world->height + 2) * world->stride * sizeof(*world->current_world));
-    memset(world->next_world, 0, (world->height + 2) * world->stride * sizeof(*world->current_world));
+    memset(world->current_world, 0, rows * world->stride * sizeof(*world->current_world));
+    memset(world->next_world, 0, rows * world->stride * sizeof(*world->current_world));
+}
+
+// marks the whole world as possibly alive
+void full_bounds(World *world) {
+    world->min_living_x = world->border;
+    world->min_living_y = world->border;
+    world->max_living_x = world->width + world->border - 1;
+    world->max_living_y = world->height + world->border - 1;
+}
+
+// The living box is collected from the cells a step reads, so it lags one generation:
+// current cells can be up to radius cells outside it. Gives the half-open range of
+// world cells (0-based) that can be alive now, widened to the whole axis when it
+// reaches the opposite edge through the torus. Empty if x0 >= x1 or y0 >= y1.
+void live_bounds(const World *world, int *x0, int *y0, int *x1, int *y1) {
+    int b = world->border;
+    int r = world->radius;
+    *x0 = (int)world->min_living_x - b - r;
+    *y0 = (int)world->min_living_y - b - r;
+    *x1 = (int)world->max_living_x - b + r + 1;
+    *y1 = (int)world->max_living_y - b + r + 1;
+    if (*x0 < 0 || *x1 > (int)world->width) {
+        *x0 = 0;
+        *x1 = world->width;
+    }
+    if (*y0 < 0 || *y1 > (int)world->height) {
+        *y0 = 0;
+        *y1 = world->height;
+    }
 }
 
 void rand_world(World *world, unsigned char types) {
-    for (uint i = 1; i <= world->height; i++) {
-        for (uint j = 1; j <= world->width; j++) {
+    uint b = world->border;
+    for (uint i = b; i < world->height + b; i++) {
+        for (uint j = b; j < world->width + b; j++) {
             world->current_world[i * world->stride + j] = rand() % types;
             // current_world[i * width + j] = (i+j) % 2;
         }
     }
-    world->min_living_x = 1;
-    world->min_living_y = 1;
-    world->max_living_x = world->width;
-    world->max_living_y = world->height;
+    full_bounds(world);
 }
 
 void free_world(World *world) {
     if (world->world_1) free(world->world_1);
     if (world->world_2) free(world->world_2);
+    if (world->sums) free(world->sums);
     world->world_1 = NULL;
     world->world_2 = NULL;
     world->current_world = NULL;
     world->next_world = NULL;
+    world->sums = NULL;
 }
 
 void set_cell(World *world, uint x, uint y, unsigned char value) {
-    if (x >= 0 && x < world->width && y >= 0 && y < world->height)
-        world->current_world[(y + 1) * world->stride + (x + 1)] = value;
+    if (x >= world->width || y >= world->height) return;
+    uint b = world->border;
+    world->current_world[(y + b) * world->stride + (x + b)] = value;
 
-    if (value) {
-        world->min_living_x = min(world->min_living_x, x);
-        world->max_living_x = max(world->max_living_x, x);
-        world->min_living_y = min(world->min_living_y, y);
-        world->max_living_y = max(world->max_living_y, y);
+    if (value) { // bounding box is in ghost-offset coordinates
+        world->min_living_x = min(world->min_living_x, x + b);
+        world->max_living_x = max(world->max_living_x, x + b);
+        world->min_living_y = min(world->min_living_y, y + b);
+        world->max_living_y = max(world->max_living_y, y + b);
     }
 }
 
@@ -86,55 +128,161 @@ uint count_neighbors(uint x, uint y, char type, World *world) {
 void wrap_edges(World* world) {
     uint w = world->width;
     uint h = world->height;
-    for (uint x = 1; x <= w; x++) {
-        world->current_world[x] = world->current_world[(h) * world->stride + x]; // setting top ghost row to real bottom row
-        world->current_world[(h + 1) * world->stride + x] = world->current_world[1 * world->stride + x]; // bottom ghost row
+    uint b = world->border;
+    uint stride = world->stride;
+    unsigned char *current = world->current_world;
+    for (uint k = 0; k < b; k++) {
+        memcpy(current + k * stride + b, current + (h + k) * stride + b, w); // top ghost rows from real bottom rows
+        memcpy(current + (h + b + k) * stride + b, current + (b + k) * stride + b, w); // bottom ghost rows
     }
-    for (uint y = 0; y <= h + 1; y++) { // corners too
-        world->current_world[y * world->stride] = world->current_world[y * world->stride + w]; // left ghost column
-        world->current_world[y * world->stride + w + 1] = world->current_world[y * world->stride + 1]; // right ghost column
+    for (uint y = 0; y < h + 2 * b; y++) { // corners too
+        unsigned char *row = current + y * stride;
+        for (uint k = 0; k < b; k++) {
+            row[k] = row[w + k]; // left ghost columns
+            row[w + b + k] = row[b + k]; // right ghost columns
+        }
     }
 }
 
-void step_world(World *world) {
-    wrap_edges(world);
+static inline unsigned char apply_rule(World *world, unsigned char cell, uint count) {
+    if (cell == 1) return count >= world->survive_min && count <= world->survive_max;
+    return count >= world->birth_min && count <= world->birth_max;
+}
+
+static inline void track_living(World *world, unsigned char cell, uint i, uint j) {
+    if (cell) {
+        if (i < world->min_living_y) world->min_living_y = i;
+        if (i > world->max_living_y) world->max_living_y = i;
+        if (j < world->min_living_x) world->min_living_x = j;
+        if (j > world->max_living_x) world->max_living_x = j;
+    }
+}
+
+// range-r Moore: column sums slide down the rows, the box sum slides along the row
+static void step_moore(World *world, uint min_x, uint max_x, uint min_y, uint max_y) {
     unsigned char *current = world->current_world;
     unsigned char *next = world->next_world;
-    uint min_y = world->min_living_y - 1;
-    uint max_y = world->max_living_y + 1;
-    uint min_x = world->min_living_x - 1;
-    uint max_x = world->max_living_x + 1;
-    if (min_x < 1 || max_x > world->width) { // если вышли за пределы поля, пересчитываем всё поле
-        max_x = world->width;
-        min_x = 1;
-    }
-    if (min_y < 1 || max_y > world->height) {
-        max_y = world->height;
-        min_y = 1;
-    }
-
-    world->min_living_x = world->width;
-    world->min_living_y = world->height;
-    world->max_living_x = 1;
-    world->max_living_y = 1;
-    // printf("final %d %d %d %d\n", min_x, max_x, min_y, max_y);
     uint stride = world->stride;
+    uint r = world->radius;
+    uint *cols = world->sums;
+    for (uint x = min_x - r; x <= max_x + r; x++) {
+        cols[x] = 0;
+        for (uint y = min_y - r; y <= min_y + r; y++) cols[x] += current[y * stride + x] == 1;
+    }
     for (uint i = min_y; i <= max_y; i++) {
+        uint sum = 0;
+        for (uint x = min_x - r; x <= min_x + r; x++) sum += cols[x];
         for (uint j = min_x; j <= max_x; j++) {
-            uint count = count_neighbors(j, i, 1, world);
-            // uint count = 2;
             unsigned char cell = current[i * stride + j];
-            if (cell) {
-                if (i < world->min_living_y) world->min_living_y = i;
-                if (i > world->max_living_y) world->max_living_y = i;
-                if (j < world->min_living_x) world->min_living_x = j;
-                if (j > world->max_living_x) world->max_living_x = j;
+            uint count = sum - (world->count_self ? 0 : cell == 1);
+            track_living(world, cell, i, j);
+            next[i * stride + j] = apply_rule(world, cell, count);
+            if (j < max_x) sum += cols[j + r + 1] - cols[j - r];
+        }
+        if (i < max_y) {
+            const unsigned char *add = current + (i + r + 1) * stride;
+            const unsigned char *sub = current + (i - r) * stride;
+            for (uint x = min_x - r; x <= max_x + r; x++) cols[x] += (add[x] == 1) - (sub[x] == 1);
+        }
+    }
+}
+
+// range-r von Neumann: the diamond slides along the row, its edges are diagonal
+// segments taken from diagonal prefix sums
+static void step_von_neumann(World *world, uint min_x, uint max_x, uint min_y, uint max_y) {
+    unsigned char *current = world->current_world;
+    unsigned char *next = world->next_world;
+    uint stride = world->stride;
+    int r = world->radius;
+    uint pad = stride + 2;
+    uint rows = world->height + 2 * world->border;
+    uint *dr = world->sums;                 // sum along the down-right diagonal ending at the cell
+    uint *dl = world->sums + pad * (rows + 2); // sum along the down-left diagonal ending at the cell
+    #define DR(y, x) dr[((y) + 1) * pad + (x) + 1]
+    #define DL(y, x) dl[((y) + 1) * pad + (x) + 1]
+
+    int x0 = min_x - r, x1 = max_x + r, y0 = min_y - r, y1 = max_y + r;
+    for (int x = x0 - 1; x <= x1 + 1; x++) { // zero frame so diagonals start inside the area
+        DR(y0 - 1, x) = 0;
+        DL(y0 - 1, x) = 0;
+    }
+    for (int y = y0; y <= y1; y++) {
+        DR(y, x0 - 1) = 0;
+        DL(y, x1 + 1) = 0;
+        for (int x = x0; x <= x1; x++) {
+            uint alive = current[y * stride + x] == 1;
+            DR(y, x) = alive + DR(y - 1, x - 1);
+            DL(y, x) = alive + DL(y - 1, x + 1);
+        }
+    }
+
+    for (int i = min_y; i <= (int)max_y; i++) {
+        uint sum = 0;
+        for (int dy = -r; dy <= r; dy++) {
+            int span = r - abs(dy);
+            for (int dx = -span; dx <= span; dx++) sum += current[(i + dy) * stride + min_x + dx] == 1;
+        }
+        for (int j = min_x; j <= (int)max_x; j++) {
+            unsigned char cell = current[i * stride + j];
+            uint count = sum - (world->count_self ? 0 : cell == 1);
+            track_living(world, cell, i, j);
+            next[i * stride + j] = apply_rule(world, cell, count);
+            if (j < (int)max_x) {
+                sum += DL(i + r, j + 1) - DL(i - 1, j + r + 2);   // lower right edge
+                sum += DR(i - 1, j + r) - DR(i - r - 1, j);       // upper right edge
+                sum -= DR(i + r, j) - DR(i - 1, j - r - 1);       // lower left edge
+                sum -= DL(i - 1, j - r + 1) - DL(i - r - 1, j + 1); // upper left edge
             }
-            next[i * stride + j] = ((cell == 1 && (count == 2 || count == 3)) || (cell == 0 && (count == 3)));
+        }
+    }
+    #undef DR
+    #undef DL
+}
+
+void step_world(World *world) {
+    wrap_edges(world);
+    unsigned char *current = world->current_world;
+    unsigned char *next = world->next_world;
+    uint b = world->border;
+    // the box lags one generation (see live_bounds), so the next one can reach 2r beyond it
+    int reach = 2 * world->radius;
+    int min_y = (int)world->min_living_y - reach;
+    int max_y = (int)world->max_living_y + reach;
+    int min_x = (int)world->min_living_x - reach;
+    int max_x = (int)world->max_living_x + reach;
+    if (min_x < (int)b || max_x > (int)(world->width + b - 1)) { // если вышли за пределы поля, пересчитываем всё поле
+        max_x = world->width + b - 1;
+        min_x = b;
+    }
+    if (min_y < (int)b || max_y > (int)(world->height + b - 1)) {
+        max_y = world->height + b - 1;
+        min_y = b;
+    }
+
+    world->min_living_x = world->width + b - 1;
+    world->min_living_y = world->height + b - 1;
+    world->max_living_x = b;
+    world->max_living_y = b;
+    // printf("final %d %d %d %d\n", min_x, max_x, min_y, max_y);
+    if (world->neighborhood == NEIGHBORHOOD_VON_NEUMANN) {
+        step_von_neumann(world, min_x, max_x, min_y, max_y);
+    } else if (world->radius > 1) {
+        step_moore(world, min_x, max_x, min_y, max_y);
+    } else {
+        uint stride = world->stride;
+        for (int i = min_y; i <= max_y; i++) {
+            for (int j = min_x; j <= max_x; j++) {
+                uint count = count_neighbors(j, i, 1, world);
+                // uint count = 2;
+                unsigned char cell = current[i * stride + j];
+                if (world->count_self) count += cell == 1;
+                track_living(world, cell, i, j);
+                next[i * stride + j] = apply_rule(world, cell, count);
 
+            }
         }
     }
     unsigned char *temp = world->current_world;
     world->current_world = world->next_world;
     world->next_world = temp;
-}
\ No newline at end of file
+}
@@ -2,14 +2,27 @@
 #ifndef WORLD_H
 #define WORLD_H
 
+#define NEIGHBORHOOD_MOORE 0
+#define NEIGHBORHOOD_VON_NEUMANN 1
+
 typedef struct {
     unsigned int width, height;
     unsigned int stride;
+    unsigned int border;    // ширина рамки призрачных ячеек (= radius)
     unsigned char types;
+
+    // Правило (Larger than Life), задаётся до init_world. Нули - классическая "Жизнь" B3/S23
+    unsigned int radius;
+    unsigned char neighborhood;
+    unsigned char count_self;   // учитывать ли саму клетку в числе соседей
+    unsigned int birth_min, birth_max;
+    unsigned int survive_min, survive_max;
+
     unsigned char* world_1; // призрачные ячейки включены
     unsigned char* world_2;
     unsigned char *current_world;
     unsigned char *next_world;
+    unsigned int *sums;     // буфер для подсчёта соседей при radius > 1
     unsigned int min_living_x, min_living_y, max_living_x, max_living_y;
 } World;
 
@@ -17,6 +30,8 @@ void init_world(World *world);
 void rand_world(World *world, unsigned char types);
 void free_world(World *world);
 void set_cell(World *world, unsigned int x, unsigned int y, unsigned char value);
+void full_bounds(World *world);
+void live_bounds(const World *world, int *x0, int *y0, int *x1, int *y1);
 void wrap_edges(World* world);
 void step_world(World *world);
 